@@ -18,6 +18,9 @@
 #include <sstream>
 #include <math.h>
 #include <deque>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
 
 using namespace std;
 
@@ -30,6 +33,11 @@ const static int DATA_DIMENSIONS = 4;                                   // 4D fo
 const static string UCM_FILE1 = "ucm1";                     // file 1 for writing UCM to
 const static string UCM_FILE2 = "ucm2";                     // file 2 for writing UCM to (alternating file) - PARALLEL
 const static string SVD_FILE = "svd";                       // safe file for SVD calculations (read by SVD, written by alternating file 1/2) - PARALLEL
+const static string SUBSPACE_FILE = "subspace";             // binary file for converged error subspace (ranks, singular values/vectors)
+const static bool QUANTIZE_SUBSPACE = true;                 // store singular vectors as 16-bit values with per-mode scaling
+const static int SUBSPACE_VERSION = 1;                      // subspace file format version
+const static long SUBSPACE_HEADER_SIZE = 6 * sizeof(int32_t) + 2 * sizeof(double);   // subspace file header size (bytes), mode chunks follow
+const static long SUBSPACE_PIECE_LENGTH = 65536;            // vector values buffered per write when streaming a mode
 
 
 /*
@@ -72,6 +80,9 @@ public:
     time_t deadline_time;                                   // max time to completion
     double initial_conditions;                              // initial condition for dominant errors (assumed available)
     double central_forecast[DATA_DIMENSIONS];               // central forecast
+    long subspace_length;                                   // length of each singular vector
+    deque<double> singular_values;                          // singular values of UCM (one per mode)
+    deque<double> singular_vectors;                         // singular vectors of UCM (mode-major, subspace_length per mode)
     
     /*
      *  ESSE Constructor
@@ -82,6 +93,9 @@ public:
         // set initial ensemble size
         n = INITIAL_ENSEMBLE_SIZE;
         
+        // no error subspace until SVD computed
+        subspace_length = 0;
+        
         // calculate unperturbed central forecast
         forecast();
         
@@ -115,7 +129,7 @@ public:
      */
     void svd_matrix(double rank[], string file){
         
-        // TODO: Compute rank values
+        // TODO: Compute rank values, store singular values/vectors (subspace_length = ensemble size)
         rank[0] = 1;
         rank[1] = 1;
     }
@@ -245,6 +259,141 @@ public:
         // TODO: update SVD file
         
     }
+    
+    
+    /*
+     *  Size (bytes) of a single mode chunk in the subspace file
+     *  Chunk: singular value | scale | singular vector (double, or int16 if quantized), padded to 8 bytes
+     *
+     *  @param quantize (store singular vectors as 16-bit values with per-mode scaling)
+     */
+    long subspace_chunk_size(bool quantize){
+        
+        long size = 2 * sizeof(double) + subspace_length * (long)(quantize ? sizeof(int16_t) : sizeof(double));
+        
+        // pad so every chunk (and its doubles) stays 8-byte aligned when mapped
+        return (size + 7) / 8 * 8;
+    }
+    
+    
+    /*
+     *  Write subspace header to file (truncates existing file)
+     *  Header: "ESSE" | version | modes | length | quantized | padding | rank E | rank II
+     *
+     *  @param rank (array) [0] = E   [1] = II
+     *  @param quantize (store singular vectors as 16-bit values with per-mode scaling)
+     *  @return true if header written
+     */
+    bool write_subspace_header(double rank[], string filename, bool quantize){
+        
+        // header stores counts as int32 - reject subspaces it cannot describe
+        long modes = singular_values.size();
+        if (modes > INT32_MAX || subspace_length < 0 || subspace_length > INT32_MAX || (long)singular_vectors.size() != modes * subspace_length){
+            return false;
+        }
+        
+        int32_t header[6] = {0, SUBSPACE_VERSION, (int32_t)modes, (int32_t)subspace_length, quantize, 0};
+        memcpy(header, "ESSE", 4);
+        static_assert(sizeof(header) + 2 * sizeof(double) == SUBSPACE_HEADER_SIZE, "subspace header layout changed");
+        
+        ofstream f;
+        f.open (filename, ios::out | ios::binary | ios::trunc);
+        f.write((char *)header, sizeof(header));
+        f.write((char *)rank, 2 * sizeof(double));
+        f.close();
+        
+        return !f.fail();
+    }
+    
+    
+    /*
+     *  Write a single mode chunk at its fixed offset - modes may be written in any order once header exists
+     *
+     *  @param mode (index of singular value/vector)
+     *  @param quantize (store singular vectors as 16-bit values with per-mode scaling)
+     *  @return true if chunk written
+     */
+    bool write_subspace_mode(long mode, string filename, bool quantize){
+        
+        long first = mode * subspace_length;                // index of first vector value for this mode
+        long vector_size = subspace_length * (long)(quantize ? sizeof(int16_t) : sizeof(double));
+        
+        // singular value, scale
+        double values[2] = {singular_values[mode], 1};
+        
+        if (quantize){
+            
+            // scale vector so largest magnitude maps to int16 max
+            double max_value = 0;
+            for (long i = 0; i < subspace_length; i++){
+                max_value = fmax(max_value, fabs(singular_vectors[first + i]));
+            }
+            if (max_value > 0){
+                values[1] = max_value / INT16_MAX;
+            }
+        }
+        
+        // each writer opens its own stream so modes can be written concurrently
+        fstream f;
+        f.open (filename, ios::in | ios::out | ios::binary);
+        f.seekp(SUBSPACE_HEADER_SIZE + mode * subspace_chunk_size(quantize));
+        f.write((char *)values, sizeof(values));
+        
+        // write vector in bounded pieces so large modes are never buffered whole
+        vector<double> piece;
+        vector<int16_t> quantized_piece;
+        for (long start = 0; start < subspace_length && f; start += SUBSPACE_PIECE_LENGTH){
+            
+            long length = min(SUBSPACE_PIECE_LENGTH, subspace_length - start);
+            
+            if (quantize){
+                quantized_piece.resize(length);
+                for (long i = 0; i < length; i++){
+                    quantized_piece[i] = (int16_t)lround(singular_vectors[first + start + i] / values[1]);
+                }
+                f.write((char *)quantized_piece.data(), length * sizeof(int16_t));
+            }else{
+                piece.resize(length);
+                for (long i = 0; i < length; i++){
+                    piece[i] = singular_vectors[first + start + i];
+                }
+                f.write((char *)piece.data(), length * sizeof(double));
+            }
+        }
+        
+        // pad chunk to 8 bytes
+        char padding[8] = {0};
+        f.write(padding, subspace_chunk_size(quantize) - 2 * sizeof(double) - vector_size);
+        f.close();
+        
+        return !f.fail();
+    }
+    
+    
+    /*
+     *  Write converged error subspace (ranks, singular values/vectors) to binary file
+     *
+     *  @param rank (array) [0] = E   [1] = II
+     *  @param quantize (store singular vectors as 16-bit values with per-mode scaling)
+     *  @return true if header and every mode written
+     */
+    bool write_subspace(double rank[], string filename, bool quantize){
+        
+        if (!write_subspace_header(rank, filename, quantize)){
+            return false;
+        }
+        
+        // mode count range checked by header
+        int modes = singular_values.size();
+        bool written = true;
+        
+        for (int mode = 0; mode < modes; mode++){
+            written = write_subspace_mode(mode, filename, quantize) && written;
+        }
+        
+        return written;
+    }
+
 };
 
 
@@ -256,6 +405,7 @@ int main() {
     time_t current_time = time(0);
     bool convergence = false;
     double prev_rank[2];
+    bool subspace_written = false;
     
     
     // compute ESSE, increasing N until completion condition met
@@ -310,6 +460,11 @@ int main() {
         // test convergence
         convergence = se.converged(prev_rank, new_rank);
         
+        // if convergence reached, write error subspace for downstream assimilation
+        if (convergence){
+            subspace_written = se.write_subspace(new_rank, SUBSPACE_FILE, QUANTIZE_SUBSPACE);
+        }
+        
         // if convergence not reached, increment ensemble size
         if (!convergence){
             se.n += 1;
@@ -323,7 +478,11 @@ int main() {
     
     
     if (convergence){
-        cout << "Error Subspace successfully calculated! " << endl;
+        if (subspace_written){
+            cout << "Error Subspace successfully calculated! " << endl;
+        }else{
+            cout << "Error Subspace calculated, but failed to write subspace file: " << SUBSPACE_FILE << endl;
+        }
         cout << "Total execution time: " << (current_time - se.start_time) << " seconds. " << endl;
     }else{
         